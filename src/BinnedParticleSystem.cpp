@@ -1,7 +1,8 @@
 #include "BinnedParticleSystem.h"
 
 BinnedParticleSystem::BinnedParticleSystem() :
-  timeStep(100) {
+  timeStep(100),
+  forceLines(NULL) {
   }
 
 void BinnedParticleSystem::setup(int width, int height, int k) {
@@ -18,6 +19,10 @@ void BinnedParticleSystem::setTimeStep(float timeStep) {
   this->timeStep = timeStep;
 }
 
+void BinnedParticleSystem::setForceLines(vector<ofVec2f>* forceLines) {
+  this->forceLines = forceLines;
+}
+
 void BinnedParticleSystem::add(BinnedParticle particle) {
   particles.push_back(particle);
 }
@@ -153,8 +158,13 @@ void BinnedParticleSystem::addForce(float targetX, float targetY, float radius,
         length = xd * xd + yd * yd;
         if(length > 0 && length < maxrsq) {
 #ifdef DRAW_FORCES
-          glVertex2f(targetX, targetY);
-          glVertex2f(curBinnedParticle.x, curBinnedParticle.y);
+          if(forceLines) {
+            forceLines->push_back(ofVec2f(targetX, targetY));
+            forceLines->push_back(ofVec2f(curBinnedParticle.x, curBinnedParticle.y));
+          } else {
+            glVertex2f(targetX, targetY);
+            glVertex2f(curBinnedParticle.x, curBinnedParticle.y);
+          }
 #endif
 #ifdef USE_INVSQRT
           xhalf = 0.5f * length;
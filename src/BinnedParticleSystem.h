@@ -12,12 +12,15 @@ class BinnedParticleSystem {
     vector<BinnedParticle> particles;
     vector< vector<BinnedParticle*> > bins;
     int width, height, k, xBins, yBins, binSize;
+    vector<ofVec2f>* forceLines;
 
   public:
     BinnedParticleSystem();
 
     void setup(int width, int height, int k);
     void setTimeStep(float timeStep);
+    // collect force lines here instead of emitting GL vertices, NULL for GL
+    void setForceLines(vector<ofVec2f>* forceLines);
 
     void add(BinnedParticle particle);
     vector<BinnedParticle*> getNeighbors(BinnedParticle& particle, float radius);
@@ -0,0 +1,135 @@
+#include "FrameCapture.h"
+
+FrameCapture::FrameCapture() :
+  width(0), height(0),
+  dropPolicy(CAPTURE_DROP_NEWEST),
+  running(false),
+  dropped(0), written(0) {
+  }
+
+FrameCapture::~FrameCapture() {
+  close();
+}
+
+void FrameCapture::setup(int width, int height, int buffers, int threads) {
+  close();
+  this->width = width;
+  this->height = height;
+  if(threads <= 0)
+    threads = max(1u, thread::hardware_concurrency() / 2);
+  this->buffers.resize(buffers);
+  available.clear();
+  queue.clear();
+  for(int i = 0; i < buffers; i++) {
+    this->buffers[i].allocate(width, height, OF_IMAGE_COLOR);
+    available.push_back(&this->buffers[i]);
+  }
+  running = true;
+  for(int i = 0; i < threads; i++) {
+    encoders.push_back(thread(&FrameCapture::encode, this));
+  }
+}
+
+void FrameCapture::setDropPolicy(CaptureDropPolicy dropPolicy) {
+  lock_guard<mutex> guard(lock);
+  this->dropPolicy = dropPolicy;
+}
+
+void FrameCapture::close() {
+  {
+    lock_guard<mutex> guard(lock);
+    running = false;
+  }
+  queued.notify_all();
+  released.notify_all();
+  // encoders finish whatever is queued before they return
+  for(unsigned i = 0; i < encoders.size(); i++) {
+    encoders[i].join();
+  }
+  encoders.clear();
+}
+
+ofPixels* FrameCapture::acquire() {
+  unique_lock<mutex> guard(lock);
+  if(available.empty()) {
+    if(dropPolicy == CAPTURE_BLOCK) {
+      released.wait(guard, [this]() { return !available.empty() || !running; });
+    } else if(dropPolicy == CAPTURE_DROP_OLDEST && !queue.empty()) {
+      ofPixels* pixels = queue.front().pixels;
+      queue.pop_front();
+      dropped++;
+      return pixels;
+    }
+  }
+  if(available.empty() || !running) {
+    dropped++;
+    return NULL;
+  }
+  ofPixels* pixels = available.back();
+  available.pop_back();
+  return pixels;
+}
+
+void FrameCapture::submit(ofPixels* pixels, string path, bool flip) {
+  Job job;
+  job.pixels = pixels;
+  job.path = path;
+  job.flip = flip;
+  {
+    lock_guard<mutex> guard(lock);
+    queue.push_back(job);
+  }
+  queued.notify_one();
+}
+
+bool FrameCapture::add(const unsigned char* data, int width, int height, string path, bool flip) {
+  if(width != this->width || height != this->height) {
+    ofLogWarning("FrameCapture") << "frame is " << width << "x" << height
+      << ", buffers are " << this->width << "x" << this->height;
+    return false;
+  }
+  ofPixels* pixels = acquire();
+  if(pixels == NULL)
+    return false;
+  memcpy(pixels->getData(), data, pixels->getTotalBytes());
+  submit(pixels, path, flip);
+  return true;
+}
+
+void FrameCapture::encode() {
+  unique_lock<mutex> guard(lock);
+  while(true) {
+    queued.wait(guard, [this]() { return !queue.empty() || !running; });
+    if(queue.empty())
+      return;
+    Job job = queue.front();
+    queue.pop_front();
+    guard.unlock();
+    write(job);
+    guard.lock();
+    available.push_back(job.pixels);
+    written++;
+    released.notify_one();
+  }
+}
+
+void FrameCapture::write(Job& job) {
+  if(job.flip)
+    job.pixels->mirror(true, false);
+  if(ofFilePath::getFileExt(job.path) == "raw") {
+    ofstream out(ofToDataPath(job.path).c_str(), ios::binary);
+    out.write((const char*) job.pixels->getData(), job.pixels->getTotalBytes());
+  } else {
+    ofSaveImage(*job.pixels, job.path);
+  }
+}
+
+unsigned FrameCapture::getDropped() {
+  lock_guard<mutex> guard(lock);
+  return dropped;
+}
+
+unsigned FrameCapture::getWritten() {
+  lock_guard<mutex> guard(lock);
+  return written;
+}
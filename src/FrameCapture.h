@@ -0,0 +1,59 @@
+#pragma once
+
+#include "ofMain.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+enum CaptureDropPolicy {
+  CAPTURE_DROP_NEWEST, // skip the incoming frame
+  CAPTURE_DROP_OLDEST, // reuse the buffer of the oldest frame not yet encoding
+  CAPTURE_BLOCK // wait for an encoder, for offline rendering
+};
+
+// writes frames from a pool of preallocated buffers on background encoder
+// threads. the file extension picks the encoder: ".raw" dumps the bytes,
+// anything else goes through ofSaveImage. when every buffer is busy the
+// drop policy decides. screen grabs come from a ScreenReader.
+class FrameCapture {
+  protected:
+    struct Job {
+      ofPixels* pixels;
+      string path;
+      bool flip;
+    };
+
+    int width, height;
+    CaptureDropPolicy dropPolicy;
+    vector<ofPixels> buffers;
+    vector<ofPixels*> available;
+    deque<Job> queue;
+    vector<thread> encoders;
+    mutex lock;
+    condition_variable queued, released;
+    bool running;
+    unsigned dropped, written;
+
+    void encode();
+    void write(Job& job);
+
+  public:
+    FrameCapture();
+    ~FrameCapture();
+
+    void setup(int width, int height, int buffers = 8, int threads = 0);
+    void setDropPolicy(CaptureDropPolicy dropPolicy);
+    void close();
+
+    // a free buffer to fill, or NULL if the frame is dropped
+    ofPixels* acquire();
+    void submit(ofPixels* pixels, string path, bool flip = false);
+    // copies width * height RGB pixels into a pooled buffer and submits it,
+    // false if the frame is dropped or its size does not match the buffers
+    bool add(const unsigned char* pixels, int width, int height, string path, bool flip = false);
+
+    unsigned getDropped();
+    unsigned getWritten();
+};
@@ -0,0 +1,71 @@
+#include "ScreenReader.h"
+
+ScreenReader::ScreenReader() :
+  width(0), height(0),
+  next(0), frames(0) {
+  }
+
+void ScreenReader::setup(int width, int height, int buffers) {
+  close();
+  this->width = width;
+  this->height = height;
+  readbacks.resize(buffers);
+  for(int i = 0; i < buffers; i++) {
+    readbacks[i].buffer.allocate(width * height * 3, GL_STREAM_READ);
+  }
+}
+
+void ScreenReader::close() {
+  readbacks.clear();
+  pending.clear();
+  next = 0;
+}
+
+bool ScreenReader::read() {
+  if(readbacks.empty() || (int) pending.size() == (int) readbacks.size())
+    return false;
+  if(ofGetWidth() != width || ofGetHeight() != height) {
+    ofLogWarning("ScreenReader") << "screen is " << ofGetWidth() << "x" << ofGetHeight()
+      << ", buffers are " << width << "x" << height;
+    return false;
+  }
+  Readback& readback = readbacks[next];
+  readback.buffer.bind(GL_PIXEL_PACK_BUFFER);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, 0);
+  readback.buffer.unbind(GL_PIXEL_PACK_BUFFER);
+  readback.frame = frames;
+  pending.push_back(next);
+  next = (next + 1) % readbacks.size();
+  return true;
+}
+
+void ScreenReader::update(const function<void(const unsigned char*)>& done) {
+  frames++;
+  while(!pending.empty() && frames - readbacks[pending.front()].frame > readbacks.size() - 1) {
+    finish(done);
+  }
+}
+
+void ScreenReader::flush(const function<void(const unsigned char*)>& done) {
+  while(!pending.empty()) {
+    finish(done);
+  }
+}
+
+void ScreenReader::finish(const function<void(const unsigned char*)>& done) {
+  Readback& readback = readbacks[pending.front()];
+  pending.pop_front();
+  const unsigned char* pixels = (const unsigned char*) readback.buffer.map(GL_READ_ONLY);
+  done(pixels);
+  if(pixels != NULL)
+    readback.buffer.unmap();
+}
+
+int ScreenReader::getWidth() const {
+  return width;
+}
+
+int ScreenReader::getHeight() const {
+  return height;
+}
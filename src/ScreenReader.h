@@ -0,0 +1,41 @@
+#pragma once
+
+#include "ofMain.h"
+
+// reads the framebuffer back through a ring of pixel pack buffers, so
+// glReadPixels returns at once and each frame is mapped a couple of
+// frames later, once the GPU is done with it. frames come back bottom up,
+// in the order they were read.
+class ScreenReader {
+  protected:
+    struct Readback {
+      ofBufferObject buffer;
+      unsigned frame;
+    };
+
+    int width, height;
+    vector<Readback> readbacks;
+    deque<int> pending;
+    int next;
+    unsigned frames;
+
+    void finish(const function<void(const unsigned char*)>& done);
+
+  public:
+    ScreenReader();
+
+    void setup(int width, int height, int buffers = 3);
+    void close();
+
+    // starts reading back the current framebuffer, false if the ring is
+    // full or the window no longer matches the buffers
+    bool read();
+    // once per frame after read(), passes each frame read buffers - 1
+    // frames ago to done, or NULL if it could not be mapped
+    void update(const function<void(const unsigned char*)>& done);
+    // maps everything still pending, the GL context has to be alive
+    void flush(const function<void(const unsigned char*)>& done);
+
+    int getWidth() const;
+    int getHeight() const;
+};
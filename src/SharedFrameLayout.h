@@ -0,0 +1,130 @@
+#pragma once
+
+// memory layout of the POSIX shared memory ring buffer written by
+// SharedFramePublisher. this header does not depend on openFrameworks
+// so other processes can include it, see tools/shmconsumer.
+//
+// [header][slot 0][slot 1]...[slot n - 1], each slot holding
+// [SharedFrameSlot][pixels][particles], every block 64 byte aligned.
+// frame s (starting at 1) goes to slot s % slots. a slot's lock is odd
+// while it is being written and 2 * s once frame s is complete, so a
+// reader that sees the same even value before and after reading knows
+// the data was not overwritten underneath it.
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <pthread.h>
+#include <stdint.h>
+#include <time.h>
+
+#define SHARED_FRAME_MAGIC 0x48545044 // "DPTH"
+#define SHARED_FRAME_VERSION 3
+
+enum SharedFrameFlags {
+  SHARED_FRAME_PIXELS = 1,
+  SHARED_FRAME_PARTICLES = 2,
+  SHARED_FRAME_BOTTOM_UP = 4 // pixel rows start at the bottom, as read back from GL
+};
+
+struct SharedFrameHeader {
+  uint32_t magic, version;
+  uint32_t slots, channels;
+  uint32_t width, height;
+  uint32_t maxParticles;
+  // pid of the publisher, written first so a segment left over from a
+  // crash can be told from one in use
+  std::atomic<int32_t> owner;
+  uint64_t slotSize;
+  std::atomic<uint64_t> sequence; // last complete frame, 0 before the first
+  // process shared, readers wait on published for sequence to change. the
+  // publisher only signals when the mutex is free, so readers have to wait
+  // in short slices and check sequence again
+  pthread_mutex_t mutex;
+  pthread_cond_t published;
+};
+
+struct SharedParticle {
+  float x, y; // screen coordinates
+  float xv, yv;
+};
+
+struct SharedFrameSlot {
+  std::atomic<uint64_t> lock;
+  uint64_t sequence;
+  // the app frame the data was rendered on, screen read backs arrive
+  // a couple of frames late so this can trail sequence
+  uint64_t frame;
+  double time; // seconds since the publisher started, at that frame
+  uint32_t flags;
+  uint32_t particles;
+};
+
+inline size_t sharedFrameAlign(size_t size) {
+  return (size + 63) & ~(size_t) 63;
+}
+
+inline size_t sharedFrameSlotSize(uint32_t width, uint32_t height, uint32_t channels, uint32_t maxParticles) {
+  return sharedFrameAlign(sizeof(SharedFrameSlot)) +
+    sharedFrameAlign((size_t) width * height * channels) +
+    sharedFrameAlign((size_t) maxParticles * sizeof(SharedParticle));
+}
+
+inline size_t sharedFrameSize(uint32_t slots, size_t slotSize) {
+  return sharedFrameAlign(sizeof(SharedFrameHeader)) + slots * slotSize;
+}
+
+inline SharedFrameSlot* sharedFrameGetSlot(SharedFrameHeader* header, uint64_t sequence) {
+  char* slots = (char*) header + sharedFrameAlign(sizeof(SharedFrameHeader));
+  return (SharedFrameSlot*) (slots + (sequence % header->slots) * header->slotSize);
+}
+
+inline unsigned char* sharedFrameGetPixels(SharedFrameSlot* slot) {
+  return (unsigned char*) slot + sharedFrameAlign(sizeof(SharedFrameSlot));
+}
+
+inline SharedParticle* sharedFrameGetParticles(const SharedFrameHeader* header, SharedFrameSlot* slot) {
+  size_t pixels = (size_t) header->width * header->height * header->channels;
+  return (SharedParticle*) (sharedFrameGetPixels(slot) + sharedFrameAlign(pixels));
+}
+
+// on linux the mutex is robust, so a reader that dies holding it does not
+// stall the publisher. macOS has no robust mutexes.
+inline int sharedFrameLock(SharedFrameHeader* header) {
+  int result = pthread_mutex_lock(&header->mutex);
+#ifdef __linux__
+  if(result == EOWNERDEAD) {
+    pthread_mutex_consistent(&header->mutex);
+    result = 0;
+  }
+#endif
+  return result;
+}
+
+// pthread_mutex_trylock with the same recovery, 0 once the mutex is held
+inline int sharedFrameTryLock(SharedFrameHeader* header) {
+  int result = pthread_mutex_trylock(&header->mutex);
+#ifdef __linux__
+  if(result == EOWNERDEAD) {
+    pthread_mutex_consistent(&header->mutex);
+    result = 0;
+  }
+#endif
+  return result;
+}
+
+// pthread_cond_timedwait with the same recovery as sharedFrameLock
+inline int sharedFrameWait(SharedFrameHeader* header, const timespec* deadline) {
+  int result = pthread_cond_timedwait(&header->published, &header->mutex, deadline);
+#ifdef __linux__
+  if(result == EOWNERDEAD) {
+    pthread_mutex_consistent(&header->mutex);
+    result = 0;
+  }
+#endif
+  return result;
+}
+
+inline void sharedFrameUnlock(SharedFrameHeader* header) {
+  pthread_mutex_unlock(&header->mutex);
+}
@@ -0,0 +1,197 @@
+#include "SharedFramePublisher.h"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+  // pid recorded in an existing segment, 0 if there is none yet
+  pid_t getOwner(const string& name) {
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if(fd < 0)
+      return 0;
+    pid_t owner = 0;
+    struct stat info;
+    if(fstat(fd, &info) == 0 && (size_t) info.st_size >= sizeof(SharedFrameHeader)) {
+      void* memory = mmap(NULL, sizeof(SharedFrameHeader), PROT_READ, MAP_SHARED, fd, 0);
+      if(memory != MAP_FAILED) {
+        owner = ((SharedFrameHeader*) memory)->owner.load();
+        munmap(memory, sizeof(SharedFrameHeader));
+      }
+    }
+    ::close(fd);
+    return owner;
+  }
+}
+
+SharedFramePublisher::SharedFramePublisher() :
+  fd(-1), size(0),
+  header(NULL), slot(NULL),
+  sequence(0) {
+  }
+
+SharedFramePublisher::~SharedFramePublisher() {
+  close();
+}
+
+bool SharedFramePublisher::setup(string name, int width, int height, int maxParticles, int slots) {
+  close();
+  // never take over a segment another process is publishing to
+  fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0666);
+  if(fd < 0 && errno == EEXIST) {
+    // a segment whose owner is gone was left over from a crash. without an
+    // owner yet it is still being set up, so it counts as in use
+    pid_t owner = getOwner(name);
+    if(owner <= 0 || kill(owner, 0) == 0 || errno != ESRCH) {
+      ofLogError("SharedFramePublisher") << name << " is in use by "
+        << (owner > 0 ? "process " + ofToString(owner) : "another process")
+        << ", pick another name with --share";
+      return false;
+    }
+    ofLogNotice("SharedFramePublisher") << "reclaiming " << name << ", left over by process " << owner;
+    shm_unlink(name.c_str());
+    fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0666);
+  }
+  if(fd < 0) {
+    ofLogError("SharedFramePublisher") << "can't open " << name << ": " << strerror(errno);
+    return false;
+  }
+  // from here on the name is ours to unlink
+  this->name = name;
+  size_t slotSize = sharedFrameSlotSize(width, height, 3, maxParticles);
+  size = sharedFrameSize(slots, slotSize);
+  if(ftruncate(fd, size) < 0) {
+    ofLogError("SharedFramePublisher") << "can't resize " << name << ": " << strerror(errno);
+    close();
+    return false;
+  }
+  void* memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if(memory == MAP_FAILED) {
+    ofLogError("SharedFramePublisher") << "can't map " << name << ": " << strerror(errno);
+    close();
+    return false;
+  }
+
+  // ftruncate zeroes the memory, so every slot lock starts at 0
+  header = new (memory) SharedFrameHeader;
+  header->owner.store(getpid());
+  header->version = SHARED_FRAME_VERSION;
+  header->slots = slots;
+  header->channels = 3;
+  header->width = width;
+  header->height = height;
+  header->maxParticles = maxParticles;
+  header->slotSize = slotSize;
+  header->sequence.store(0);
+
+  pthread_mutexattr_t mutexAttr;
+  pthread_mutexattr_init(&mutexAttr);
+  pthread_mutexattr_setpshared(&mutexAttr, PTHREAD_PROCESS_SHARED);
+#ifdef __linux__
+  pthread_mutexattr_setrobust(&mutexAttr, PTHREAD_MUTEX_ROBUST);
+#endif
+  pthread_mutex_init(&header->mutex, &mutexAttr);
+  pthread_mutexattr_destroy(&mutexAttr);
+
+  pthread_condattr_t condAttr;
+  pthread_condattr_init(&condAttr);
+  pthread_condattr_setpshared(&condAttr, PTHREAD_PROCESS_SHARED);
+  pthread_cond_init(&header->published, &condAttr);
+  pthread_condattr_destroy(&condAttr);
+
+  // readers check the magic before anything else
+  atomic_thread_fence(memory_order_release);
+  header->magic = SHARED_FRAME_MAGIC;
+  sequence = 0;
+  return true;
+}
+
+void SharedFramePublisher::close() {
+  if(header != NULL) {
+    munmap(header, size);
+    header = NULL;
+    slot = NULL;
+  }
+  if(fd >= 0) {
+    ::close(fd);
+    fd = -1;
+    shm_unlink(name.c_str());
+  }
+}
+
+bool SharedFramePublisher::isOpen() const {
+  return header != NULL;
+}
+
+void SharedFramePublisher::begin(uint64_t frame, double time) {
+  if(!isOpen())
+    return;
+  sequence++;
+  slot = sharedFrameGetSlot(header, sequence);
+  slot->lock.store(sequence * 2 - 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  slot->sequence = sequence;
+  slot->frame = frame;
+  slot->time = time;
+  slot->flags = 0;
+  slot->particles = 0;
+}
+
+bool SharedFramePublisher::setPixels(const unsigned char* pixels, int width, int height, bool bottomUp) {
+  if(slot == NULL)
+    return false;
+  if(width != (int) header->width || height != (int) header->height) {
+    ofLogWarning("SharedFramePublisher") << "frame is " << width << "x" << height
+      << ", " << name << " is " << header->width << "x" << header->height;
+    return false;
+  }
+  memcpy(getPixels(), pixels, (size_t) width * height * header->channels);
+  if(bottomUp)
+    slot->flags |= SHARED_FRAME_BOTTOM_UP;
+  return true;
+}
+
+unsigned char* SharedFramePublisher::getPixels() {
+  if(slot == NULL)
+    return NULL;
+  slot->flags |= SHARED_FRAME_PIXELS;
+  return sharedFrameGetPixels(slot);
+}
+
+SharedParticle* SharedFramePublisher::getParticles() {
+  if(slot == NULL)
+    return NULL;
+  slot->flags |= SHARED_FRAME_PARTICLES;
+  return sharedFrameGetParticles(header, slot);
+}
+
+void SharedFramePublisher::end(int particles) {
+  if(slot == NULL)
+    return;
+  slot->particles = particles;
+  slot->lock.store(sequence * 2, memory_order_release);
+  slot = NULL;
+  header->sequence.store(sequence, memory_order_release);
+
+  // a reader stopped while holding the mutex must not stall the show, so
+  // the wake up is skipped when it is taken. readers wait in slices and
+  // pick the frame up from sequence anyway
+  if(sharedFrameTryLock(header) == 0) {
+    pthread_cond_broadcast(&header->published);
+    sharedFrameUnlock(header);
+  }
+}
+
+int SharedFramePublisher::getWidth() const {
+  return isOpen() ? header->width : 0;
+}
+
+int SharedFramePublisher::getHeight() const {
+  return isOpen() ? header->height : 0;
+}
+
+int SharedFramePublisher::getMaxParticles() const {
+  return isOpen() ? header->maxParticles : 0;
+}
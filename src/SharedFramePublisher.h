@@ -0,0 +1,41 @@
+#pragma once
+
+#include "ofMain.h"
+#include "SharedFrameLayout.h"
+
+// publishes frames and particles to other processes on the same machine
+// through a POSIX shared memory ring buffer. callers write straight into
+// the slot between begin() and end(), so nothing is copied on the way out.
+// screen read backs arrive late, so begin() takes the frame and time the
+// data was rendered at rather than the current ones.
+class SharedFramePublisher {
+  protected:
+    string name;
+    int fd;
+    size_t size;
+    SharedFrameHeader* header;
+    SharedFrameSlot* slot;
+    uint64_t sequence;
+
+  public:
+    SharedFramePublisher();
+    ~SharedFramePublisher();
+
+    bool setup(string name, int width, int height, int maxParticles, int slots = 4);
+    void close();
+    bool isOpen() const;
+
+    void begin(uint64_t frame, double time);
+    // copies width * height RGB pixels into the slot, false if the size
+    // does not match the segment
+    bool setPixels(const unsigned char* pixels, int width, int height, bool bottomUp);
+    // width * height RGB pixels to fill, top down
+    unsigned char* getPixels();
+    // room for getMaxParticles() particles
+    SharedParticle* getParticles();
+    void end(int particles = 0);
+
+    int getWidth() const;
+    int getHeight() const;
+    int getMaxParticles() const;
+};
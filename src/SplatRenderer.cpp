@@ -0,0 +1,307 @@
+#include "SplatRenderer.h"
+
+#include <atomic>
+#include <functional>
+#include <thread>
+
+#if defined(__SSE__) || defined(_M_X64)
+#define USE_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace {
+  // one RGBA pixel, one SSE register
+#ifdef USE_SSE
+  typedef __m128 rgba;
+  inline rgba rgbaLoad(const float* p) { return _mm_loadu_ps(p); }
+  inline void rgbaStore(float* p, rgba v) { _mm_storeu_ps(p, v); }
+  inline rgba rgbaSet(float r, float g, float b, float a) { return _mm_setr_ps(r, g, b, a); }
+  inline rgba rgbaSet1(float x) { return _mm_set1_ps(x); }
+  inline rgba rgbaAdd(rgba a, rgba b) { return _mm_add_ps(a, b); }
+  inline rgba rgbaSub(rgba a, rgba b) { return _mm_sub_ps(a, b); }
+  inline rgba rgbaMul(rgba a, rgba b) { return _mm_mul_ps(a, b); }
+  inline rgba rgbaClamp(rgba v, rgba hi) { return _mm_min_ps(_mm_max_ps(v, _mm_setzero_ps()), hi); }
+#else
+  struct rgba { float v[4]; };
+  inline rgba rgbaLoad(const float* p) { rgba r = {{p[0], p[1], p[2], p[3]}}; return r; }
+  inline void rgbaStore(float* p, rgba v) { for(int i = 0; i < 4; i++) p[i] = v.v[i]; }
+  inline rgba rgbaSet(float r, float g, float b, float a) { rgba v = {{r, g, b, a}}; return v; }
+  inline rgba rgbaSet1(float x) { return rgbaSet(x, x, x, x); }
+  inline rgba rgbaAdd(rgba a, rgba b) { for(int i = 0; i < 4; i++) a.v[i] += b.v[i]; return a; }
+  inline rgba rgbaSub(rgba a, rgba b) { for(int i = 0; i < 4; i++) a.v[i] -= b.v[i]; return a; }
+  inline rgba rgbaMul(rgba a, rgba b) { for(int i = 0; i < 4; i++) a.v[i] *= b.v[i]; return a; }
+  inline rgba rgbaClamp(rgba v, rgba hi) {
+    for(int i = 0; i < 4; i++) v.v[i] = v.v[i] < 0 ? 0 : (v.v[i] > hi.v[i] ? hi.v[i] : v.v[i]);
+    return v;
+  }
+#endif
+
+  inline void splatPixel(float* p, rgba color) {
+    rgbaStore(p, rgbaAdd(rgbaLoad(p), color));
+  }
+
+  // src over with a premultiplied color, what OF_BLENDMODE_ALPHA does on the GPU
+  inline void blendPixel(float* p, rgba color, rgba inverseAlpha) {
+    rgbaStore(p, rgbaAdd(color, rgbaMul(rgbaLoad(p), inverseAlpha)));
+  }
+
+  inline int clampIndex(int i, int n) {
+    return i < 0 ? 0 : (i >= n ? n - 1 : i);
+  }
+
+  // NUM_SAMPLES in the ofxPostProcessing zoom blur shader
+  const int zoomSamples = 100;
+  const float maxGlowRadius = 24;
+  // columns per job in the vertical glow pass, 4 cache lines of RGBA floats
+  const int glowColumns = 16;
+}
+
+SplatRenderer::SplatRenderer() :
+  width(0), height(0),
+  threads(1), tileHeight(32),
+  translateX(0), translateY(0) {
+  }
+
+void SplatRenderer::setup(int width, int height, int threads) {
+  this->width = width;
+  this->height = height;
+  if(threads <= 0)
+    threads = max(1u, thread::hardware_concurrency());
+  this->threads = threads;
+  tiles.resize((height + tileHeight - 1) / tileHeight);
+  accum.assign(width * height * 4, 0);
+  scratch.assign(width * height * 4, 0);
+  blurred.assign(width * height * 4, 0);
+}
+
+void SplatRenderer::setTranslation(float x, float y) {
+  translateX = x;
+  translateY = y;
+}
+
+void SplatRenderer::clear() {
+  splats.clear();
+  fill(accum.begin(), accum.end(), 0);
+}
+
+void SplatRenderer::addLine(float x0, float y0, float x1, float y1, const ofFloatColor& color) {
+  Splat splat;
+  splat.x0 = x0 + translateX;
+  splat.y0 = y0 + translateY;
+  splat.x1 = x1 + translateX;
+  splat.y1 = y1 + translateY;
+  splat.radius = 0;
+  splat.color.set(color.r * color.a, color.g * color.a, color.b * color.a, color.a);
+  splats.push_back(splat);
+}
+
+void SplatRenderer::addLines(const vector<ofVec2f>& vertices, const ofFloatColor& color) {
+  int n = vertices.size() - 1;
+  for(int i = 0; i < n; i += 2) {
+    addLine(vertices[i].x, vertices[i].y, vertices[i + 1].x, vertices[i + 1].y, color);
+  }
+}
+
+void SplatRenderer::addCircle(float x, float y, float radius, const ofFloatColor& color) {
+  Splat splat;
+  splat.x0 = splat.x1 = x + translateX;
+  splat.y0 = splat.y1 = y + translateY;
+  splat.radius = radius;
+  splat.color.set(color.r * color.a, color.g * color.a, color.b * color.a, color.a);
+  splats.push_back(splat);
+}
+
+void SplatRenderer::parallelFor(int n, const function<void(int)>& job) {
+  atomic<int> next(0);
+  vector<thread> workers;
+  int count = min(threads, n);
+  for(int i = 0; i < count; i++) {
+    workers.push_back(thread([&]() {
+      for(int j = next++; j < n; j = next++) {
+        job(j);
+      }
+    }));
+  }
+  for(int i = 0; i < count; i++) {
+    workers[i].join();
+  }
+}
+
+void SplatRenderer::render() {
+  // bin every splat into the tiles it touches, so each tile can be
+  // rasterized without locking
+  int n = tiles.size();
+  for(int i = 0; i < n; i++) {
+    tiles[i].clear();
+  }
+  int m = splats.size();
+  for(int i = 0; i < m; i++) {
+    const Splat& cur = splats[i];
+    float minY = min(cur.y0, cur.y1) - cur.radius - 1;
+    float maxY = max(cur.y0, cur.y1) + cur.radius + 1;
+    if(maxY < 0 || minY >= height)
+      continue;
+    int minTile = clampIndex((int) minY / tileHeight, n);
+    int maxTile = clampIndex((int) maxY / tileHeight, n);
+    for(int tile = minTile; tile <= maxTile; tile++) {
+      tiles[tile].push_back(i);
+    }
+  }
+  parallelFor(n, [this](int tile) { rasterizeTile(tile); });
+}
+
+void SplatRenderer::rasterizeTile(int tile) {
+  int minY = tile * tileHeight;
+  int maxY = min(minY + tileHeight, height);
+  const vector<unsigned>& cur = tiles[tile];
+  int n = cur.size();
+  for(int i = 0; i < n; i++) {
+    const Splat& splat = splats[cur[i]];
+    rgba color = rgbaSet(splat.color.r, splat.color.g, splat.color.b, splat.color.a);
+    rgba inverseAlpha = rgbaSet1(1 - splat.color.a);
+    if(splat.radius > 0) {
+      float rsq = splat.radius * splat.radius;
+      int top = max(minY, (int) floorf(splat.y0 - splat.radius));
+      int bottom = min(maxY - 1, (int) ceilf(splat.y0 + splat.radius));
+      for(int y = top; y <= bottom; y++) {
+        float yd = y + .5f - splat.y0;
+        if(yd * yd > rsq)
+          continue;
+        float half = sqrtf(rsq - yd * yd);
+        int left = max(0, (int) ceilf(splat.x0 - half - .5f));
+        int right = min(width - 1, (int) floorf(splat.x0 + half - .5f));
+        float* row = &accum[y * width * 4];
+        for(int x = left; x <= right; x++) {
+          blendPixel(row + x * 4, color, inverseAlpha);
+        }
+      }
+    } else {
+      // DDA, one pixel per step along the major axis, last pixel excluded
+      float xd = splat.x1 - splat.x0;
+      float yd = splat.y1 - splat.y0;
+      int steps = max(1, (int) ceilf(max(fabsf(xd), fabsf(yd))));
+      xd /= steps;
+      yd /= steps;
+      float x = splat.x0;
+      float y = splat.y0;
+      for(int j = 0; j < steps; j++, x += xd, y += yd) {
+        int px = (int) floorf(x);
+        int py = (int) floorf(y);
+        if(py >= minY && py < maxY && px >= 0 && px < width)
+          blendPixel(&accum[(py * width + px) * 4], color, inverseAlpha);
+      }
+    }
+  }
+}
+
+void SplatRenderer::applyZoomBlur(float centerX, float centerY, float exposure, float decay, float density, float weight, float clampValue) {
+  float cx = centerX * width;
+  float cy = (1 - centerY) * height;
+  float step = density / zoomSamples;
+  rgba limit = rgbaSet1(clampValue);
+  rgba gain = rgbaSet1(exposure);
+  parallelFor(height, [&](int y) {
+    float* dst = &scratch[y * width * 4];
+    for(int x = 0; x < width; x++) {
+      float u = x + .5f;
+      float v = y + .5f;
+      float ud = (u - cx) * step;
+      float vd = (v - cy) * step;
+      float illuminationDecay = 1;
+      rgba color = rgbaSet1(0);
+      for(int i = 0; i < zoomSamples; i++) {
+        u -= ud;
+        v -= vd;
+        int sx = clampIndex((int) floorf(u), width);
+        int sy = clampIndex((int) floorf(v), height);
+        rgba texel = rgbaLoad(&accum[(sy * width + sx) * 4]);
+        color = rgbaAdd(color, rgbaMul(texel, rgbaSet1(illuminationDecay * weight)));
+        illuminationDecay *= decay;
+      }
+      rgbaStore(dst + x * 4, rgbaClamp(rgbaMul(color, gain), limit));
+    }
+  });
+  accum.swap(scratch);
+}
+
+void SplatRenderer::applyGlow(float focus, float aperture, float maxBlur) {
+  int radius = (int) (maxBlur * maxGlowRadius + .5f);
+  if(radius < 1 || aperture <= 0)
+    return;
+  float threshold = 1 - focus;
+  rgba norm = rgbaSet1(1.f / (radius * 2 + 1));
+  rgba gain = rgbaSet1(aperture / (radius * 2 + 1));
+
+  // bright pass and horizontal box blur, one row per job
+  parallelFor(height, [&](int y) {
+    const float* src = &accum[y * width * 4];
+    float* bright = &scratch[y * width * 4];
+    float* dst = &blurred[y * width * 4];
+    for(int x = 0; x < width; x++) {
+      const float* p = src + x * 4;
+      float brightness = max(p[0], max(p[1], p[2]));
+      rgbaStore(bright + x * 4, brightness > threshold ? rgbaLoad(p) : rgbaSet1(0));
+    }
+    rgba sum = rgbaSet1(0);
+    for(int x = -radius; x <= radius; x++) {
+      sum = rgbaAdd(sum, rgbaLoad(bright + clampIndex(x, width) * 4));
+    }
+    for(int x = 0; x < width; x++) {
+      rgbaStore(dst + x * 4, rgbaMul(sum, norm));
+      sum = rgbaAdd(sum, rgbaLoad(bright + clampIndex(x + radius + 1, width) * 4));
+      sum = rgbaSub(sum, rgbaLoad(bright + clampIndex(x - radius, width) * 4));
+    }
+  });
+
+  // vertical box blur, added back onto the image. each job owns a block
+  // of columns and walks it row by row, so threads never share cache lines
+  int stride = width * 4;
+  parallelFor((width + glowColumns - 1) / glowColumns, [&](int block) {
+    int left = block * glowColumns;
+    int columns = min(glowColumns, width - left);
+    const float* src = &blurred[left * 4];
+    float* dst = &accum[left * 4];
+    rgba sums[glowColumns];
+    for(int x = 0; x < columns; x++) {
+      sums[x] = rgbaSet1(0);
+    }
+    for(int y = -radius; y <= radius; y++) {
+      const float* row = src + clampIndex(y, height) * stride;
+      for(int x = 0; x < columns; x++) {
+        sums[x] = rgbaAdd(sums[x], rgbaLoad(row + x * 4));
+      }
+    }
+    for(int y = 0; y < height; y++) {
+      float* row = dst + y * stride;
+      const float* next = src + clampIndex(y + radius + 1, height) * stride;
+      const float* prev = src + clampIndex(y - radius, height) * stride;
+      for(int x = 0; x < columns; x++) {
+        splatPixel(row + x * 4, rgbaMul(sums[x], gain));
+        sums[x] = rgbaSub(rgbaAdd(sums[x], rgbaLoad(next + x * 4)), rgbaLoad(prev + x * 4));
+      }
+    }
+  });
+}
+
+void SplatRenderer::getPixels(ofPixels& pixels) const {
+  pixels.allocate(width, height, OF_IMAGE_COLOR);
+  getPixels(pixels.getData());
+}
+
+void SplatRenderer::getPixels(unsigned char* dst) const {
+  int n = width * height;
+  for(int i = 0; i < n; i++) {
+    for(int c = 0; c < 3; c++) {
+      float v = ofClamp(accum[i * 4 + c], 0, 1);
+      dst[i * 3 + c] = (unsigned char) (v * 255 + .5f);
+    }
+  }
+}
+
+int SplatRenderer::getWidth() const {
+  return width;
+}
+
+int SplatRenderer::getHeight() const {
+  return height;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "ofMain.h"
+
+// software renderer for machines without a GL context. particles and
+// force lines are blended src over into a float RGBA buffer, like the GPU
+// path's default alpha blending, so values stay within [0, 1]. the buffer
+// is split into horizontal tiles, each tile rasterized on its own thread
+// in submission order.
+// the zoom blur follows the ofxPostProcessing shader, the glow stands in
+// for the depth of field pass (there is no depth buffer to focus on).
+class SplatRenderer {
+  protected:
+    struct Splat {
+      float x0, y0, x1, y1;
+      float radius; // > 0 for filled circles, lines otherwise
+      ofFloatColor color; // premultiplied
+    };
+
+    int width, height, threads, tileHeight;
+    float translateX, translateY;
+    vector<Splat> splats;
+    vector< vector<unsigned> > tiles;
+    vector<float> accum, scratch, blurred;
+
+    void parallelFor(int n, const function<void(int)>& job);
+    void rasterizeTile(int tile);
+
+  public:
+    SplatRenderer();
+
+    void setup(int width, int height, int threads = 0);
+    void setTranslation(float x, float y);
+    void clear();
+
+    void addLine(float x0, float y0, float x1, float y1, const ofFloatColor& color);
+    // vertices are consecutive pairs, as emitted for GL_LINES
+    void addLines(const vector<ofVec2f>& vertices, const ofFloatColor& color);
+    void addCircle(float x, float y, float radius, const ofFloatColor& color);
+    void render();
+
+    // center is in texture coordinates, origin bottom left like the GPU pass
+    void applyZoomBlur(float centerX, float centerY, float exposure, float decay, float density, float weight, float clampValue);
+    // pixels brighter than 1 - focus are blurred by up to maxBlur and added back scaled by aperture
+    void applyGlow(float focus, float aperture, float maxBlur);
+
+    void getPixels(ofPixels& pixels) const;
+    // width * height RGB bytes
+    void getPixels(unsigned char* pixels) const;
+
+    int getWidth() const;
+    int getHeight() const;
+};
@@ -1,6 +1,25 @@
 #include "ofApp.h"
+#include "ofAppNoWindow.h"
 
-int main() {
-	ofSetupOpenGL(1920, 1080, OF_WINDOW);
-	ofRunApp(new ofApp());
+// depths [--share name] [--headless [frames] [directory]]
+// --share names the shared memory segment, see ofApp::updatePublisher
+// --headless renders on the CPU without a GL context, writing an image sequence
+int main(int argc, char* argv[]) {
+	ofApp* app = new ofApp();
+	for(int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		if(arg == "--share" && i + 1 < argc) {
+			app->shareName = argv[++i];
+		} else if(arg == "--headless") {
+			app->headless = true;
+			if(i + 1 < argc && argv[i + 1][0] != '-') app->headlessFrames = ofToInt(argv[++i]);
+			if(i + 1 < argc && argv[i + 1][0] != '-') app->renderPath = argv[++i];
+		}
+	}
+	if(app->headless) {
+		ofSetupOpenGL(make_shared<ofAppNoWindow>(), 1920, 1080, OF_WINDOW);
+	} else {
+		ofSetupOpenGL(1920, 1080, OF_WINDOW);
+	}
+	ofRunApp(app);
 }
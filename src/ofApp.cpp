@@ -1,5 +1,12 @@
 #include "ofApp.h"
 
+ofApp::ofApp() :
+  headless(false),
+  headlessFrames(0),
+  renderedFrames(0),
+  renderPath("render") {
+  }
+
 void ofApp::setup(){
   receive.setup(5002);
   send.setup("localhost", 5003);
@@ -26,7 +33,9 @@ void ofApp::setup(){
   isMousePressed = false;
   slowMotion = true;
   drawGui = false;
-  gui.setup();
+  saveScreen = false;
+  recording = false;
+  shareFailed = false;
   ofParameterGroup group_simulation;
   group_simulation.setName("simulation");
   group_simulation.add(timeStep.set("Time Step", 100, 1, 1000));
@@ -36,7 +45,6 @@ void ofApp::setup(){
   group_simulation.add(dampingForce.set("Damping Force", 0.01, 0.0, 1.0));
   group_simulation.add(attractorCenterX.set("Attractor X", 0.5, 0.0, 1.0));
   group_simulation.add(attractorCenterY.set("Attractor Y", 0.5, 0.0, 1.0));
-  gui.add(group_simulation);
 
   // zoom pass
   ofParameterGroup group_zoom;
@@ -49,7 +57,6 @@ void ofApp::setup(){
   group_zoom.add(zoomDensity.set("z Density", 0.25, 0, 1));
   group_zoom.add(zoomWeight.set("z Weight", 0.24, 0, 1));
   group_zoom.add(zoomClamp.set("z Clamp", 1, 0, 1));
-  gui.add(group_zoom);
 
   // dof pass
   ofParameterGroup group_dof;
@@ -58,13 +65,11 @@ void ofApp::setup(){
   group_dof.add(dofFocus.set("dof Focus", 0.985, 0, 1));
   group_dof.add(dofAperture.set("dof Aperture", 0.8, 0, 1));
   group_dof.add(dofMaxBlur.set("dof Max Blur", 0.6, 0, 1));
-  gui.add(group_dof);
 
   ofParameterGroup group_post;
   group_post.setName("Postprocessing");
   group_post.add(grEnabled.set("God Rays", true));
   group_post.add(fxaaEnabled.set("fxaa", true));
-  gui.add(group_post);
 
   // colours
   ofParameterGroup group_colour;
@@ -75,9 +80,40 @@ void ofApp::setup(){
   group_colour.add(red.set("red", 255, 0, 255));
   group_colour.add(green.set("green", 250, 0, 255));
   group_colour.add(blue.set("blue", 255, 0, 255));
-  gui.add(group_colour);
+
+  // shared memory output for other processes, see tools/shmconsumer
+  ofParameterGroup group_share;
+  group_share.setName("Sharing");
+  group_share.add(sharePixels.set("Share Pixels", false));
+  group_share.add(shareParticles.set("Share Particles", false));
   drawBalls = false;
 
+  // a headless render next to the live show must not take its segment
+  if(shareName.empty())
+    shareName = headless ? "/depths-headless" : "/depths";
+
+  // the gui and the post processing passes need a GL context
+  if(headless) {
+    splatRenderer.setup(ofGetWidth(), ofGetHeight());
+    splatRenderer.setTranslation(-padding, -padding);
+    ofDirectory::createDirectory(renderPath, true, true);
+    // every frame is wanted, so wait for the encoders rather than drop
+    capture.setup(ofGetWidth(), ofGetHeight(), 4);
+    capture.setDropPolicy(CAPTURE_BLOCK);
+    return;
+  }
+
+  capture.setup(ofGetWidth(), ofGetHeight());
+  screenReader.setup(ofGetWidth(), ofGetHeight());
+
+  gui.setup();
+  gui.add(group_simulation);
+  gui.add(group_zoom);
+  gui.add(group_dof);
+  gui.add(group_post);
+  gui.add(group_colour);
+  gui.add(group_share);
+
   post.init(ofGetWidth(), ofGetHeight());
 
   dfpass = post.createPass<DofPass>();
@@ -88,6 +124,10 @@ void ofApp::setup(){
 
 void ofApp::update(){
   handleOSCMessages();
+  if(headless) {
+    renderOffline();
+    return;
+  }
   zbpass->setEnabled(zoomEnabled);
   zbpass->setCenterX(zoomCenterX);
   zbpass->setCenterY(zoomCenterY);
@@ -189,11 +229,184 @@ void ofApp::handleOSCMessages() {
     if (msgAddress == "/absoluteValues") {
       absoluteValues = m.getArgAsBool(0);
     }
+    if (msgAddress == "/sharePixels") {
+      sharePixels = m.getArgAsBool(0);
+    }
+    if (msgAddress == "/shareParticles") {
+      shareParticles = m.getArgAsBool(0);
+    }
   }
 }
 
 
+float ofApp::particleAlpha(const BinnedParticle& particle) {
+  float alphav, alphaf;
+  if (absoluteValues) {
+     alphav = ofMap(abs(particle.xv) + abs(particle.yv), 0, 20, minAlpha, maxAlpha);
+     alphaf = ofMap(abs(particle.xf) + abs(particle.yf), 0, 20, minAlpha, maxAlpha);
+  } else {
+     alphav = ofMap((particle.xv) + (particle.yv), 0, 20, minAlpha, maxAlpha);
+     alphaf = ofMap((particle.xf) + (particle.yf), 0, 20, minAlpha, maxAlpha);
+  }
+  return alphav * 0.5 + alphaf * 0.5;
+}
+
+// same simulation step as draw(), but the particles and force lines are
+// splatted by the CPU renderer and every frame is written to renderPath
+void ofApp::renderOffline() {
+  particleSystem.setTimeStep(timeStep);
+  particleSystem.setupForces();
+  particleSystem.setForceLines(&forceLines);
+  splatRenderer.clear();
+
+  float alpha = minAlpha;
+  for(int i = 0; i < particleSystem.size(); i++) {
+    BinnedParticle& cur = particleSystem[i];
+    alpha = particleAlpha(cur);
+    forceLines.clear();
+    particleSystem.addRepulsionForce(cur, particleNeighborhood, particleRepulsion);
+    if(!drawBalls) {
+      splatRenderer.addLines(forceLines, ofColor(red, green, blue, alpha));
+    }
+    cur.bounceOffWalls(0, 0, particleSystem.getWidth(), particleSystem.getHeight());
+    cur.addDampingForce(dampingForce);
+  }
+
+  particleSystem.addAttractionForce(
+      particleSystem.getWidth() * attractorCenterX,
+      particleSystem.getHeight() * attractorCenterY,
+      particleSystem.getWidth() * 100,
+      centerAttraction
+  );
+  forceLines.clear();
+  // frames are not paced in real time, so step at a fixed 60 fps
+  particleSystem.update(1. / 60);
+
+  if(drawBalls) {
+    for(int i = 0; i < particleSystem.size(); i++) {
+      splatRenderer.addCircle(particleSystem[i].x, particleSystem[i].y, particleNeighborhood * .3, ofColor(red, green, blue, alpha));
+    }
+  }
+
+  splatRenderer.render();
+  if(dofEnabled) {
+    splatRenderer.applyGlow(dofFocus, dofAperture, dofMaxBlur);
+  }
+  if(zoomEnabled) {
+    splatRenderer.applyZoomBlur(zoomCenterX, zoomCenterY, zoomExposure, zoomDecay, zoomDensity, zoomWeight, zoomClamp);
+  }
+  // simulated time, frames are stepped at a fixed 60 fps
+  if(updatePublisher()) {
+    publisher.begin(renderedFrames, renderedFrames / 60.);
+    if(sharePixels)
+      splatRenderer.getPixels(publisher.getPixels());
+    int n = 0;
+    if(shareParticles)
+      n = packParticles(publisher.getParticles(), publisher.getMaxParticles());
+    publisher.end(n);
+  }
+  ofPixels* pixels = capture.acquire();
+  if(pixels != NULL) {
+    splatRenderer.getPixels(*pixels);
+    capture.submit(pixels, renderPath + "/frame_" + ofToString(renderedFrames, 5, '0') + ".png");
+  }
+  renderedFrames++;
+  if(headlessFrames > 0 && renderedFrames >= headlessFrames) {
+    ofExit();
+  }
+}
+
+// opens the segment the first time something is shared and closes it once
+// nothing is, false while there is nowhere to publish
+bool ofApp::updatePublisher() {
+  if(!sharePixels && !shareParticles) {
+    publisher.close();
+    shareFailed = false;
+    return false;
+  }
+  if(!publisher.isOpen()) {
+    if(shareFailed)
+      return false;
+    if(!publisher.setup(shareName, ofGetWidth(), ofGetHeight(), kBinnedParticles)) {
+      // don't retry every frame, toggling sharing off and on tries again
+      shareFailed = true;
+      return false;
+    }
+  }
+  return true;
+}
+
+int ofApp::packParticles(SharedParticle* particles, int maxParticles) {
+  int n = min((int) particleSystem.size(), maxParticles);
+  for(int i = 0; i < n; i++) {
+    BinnedParticle& cur = particleSystem[i];
+    particles[i].x = cur.x - padding;
+    particles[i].y = cur.y - padding;
+    particles[i].xv = cur.xv;
+    particles[i].yv = cur.yv;
+  }
+  return n;
+}
+
+// the screen is read back once for recording, screenshots and sharing
+// alike. the pixels arrive a couple of frames later in finishFrame, so
+// everything else about the frame is kept until then
+void ofApp::grabFrame() {
+  PendingFrame frame;
+  frame.frame = ofGetFrameNum();
+  frame.time = ofGetElapsedTimef();
+  if(recording) {
+    frame.paths.push_back(recordPath + "/frame_" + ofToString(ofGetFrameNum(), 6, '0') + "." + recordExtension);
+  }
+  if(saveScreen) {
+    frame.paths.push_back(ofToString(ofGetMinutes()) + "_" + ofToString(ofGetFrameNum()) + ".png");
+    saveScreen = false;
+  }
+  frame.share = false;
+  if(updatePublisher()) {
+    if(sharePixels) {
+      frame.share = true;
+      if(shareParticles) {
+        frame.particles.resize(publisher.getMaxParticles());
+        frame.particles.resize(packParticles(&frame.particles[0], frame.particles.size()));
+      }
+    } else {
+      // nothing to wait for
+      publisher.begin(frame.frame, frame.time);
+      publisher.end(packParticles(publisher.getParticles(), publisher.getMaxParticles()));
+    }
+  }
+  if((!frame.paths.empty() || frame.share) && screenReader.read()) {
+    pendingFrames.push_back(move(frame));
+  }
+  screenReader.update([this](const unsigned char* pixels) { finishFrame(pixels); });
+}
+
+void ofApp::finishFrame(const unsigned char* pixels) {
+  PendingFrame frame = move(pendingFrames.front());
+  pendingFrames.pop_front();
+  if(pixels == NULL)
+    return;
+  int width = screenReader.getWidth();
+  int height = screenReader.getHeight();
+  for(unsigned i = 0; i < frame.paths.size(); i++) {
+    capture.add(pixels, width, height, frame.paths[i], true);
+  }
+  // sharing may have been switched off since the frame was read
+  if(frame.share && publisher.isOpen()) {
+    publisher.begin(frame.frame, frame.time);
+    publisher.setPixels(pixels, width, height, true);
+    int n = 0;
+    if(!frame.particles.empty()) {
+      n = min((int) frame.particles.size(), publisher.getMaxParticles());
+      memcpy(publisher.getParticles(), &frame.particles[0], n * sizeof(SharedParticle));
+    }
+    publisher.end(n);
+  }
+}
+
 void ofApp::draw(){
+  if(headless) return;
   post.begin();
   ofBackground(0);
 
@@ -213,15 +426,7 @@ void ofApp::draw(){
   }
   for(int i = 0; i < particleSystem.size(); i++) {
     BinnedParticle& cur = particleSystem[i];
-    float alphav, alphaf;
-    if (absoluteValues) {
-       alphav = ofMap(abs(cur.xv) + abs(cur.yv), 0, 20, minAlpha, maxAlpha);
-       alphaf = ofMap(abs(cur.xf) + abs(cur.yf), 0, 20, minAlpha, maxAlpha);
-    } else {
-       alphav = ofMap((cur.xv) + (cur.yv), 0, 20, minAlpha, maxAlpha);
-       alphaf = ofMap((cur.xf) + (cur.yf), 0, 20, minAlpha, maxAlpha);
-    }
-    float alpha = alphav * 0.5 + alphaf * 0.5;
+    float alpha = particleAlpha(cur);
     ofSetColor(red, green, blue, alpha);
     // global force on other particles
     particleSystem.addRepulsionForce(cur, particleNeighborhood, particleRepulsion);
@@ -254,15 +459,38 @@ void ofApp::draw(){
 
   ofPopMatrix();
   post.end();
+  // before the overlay text, so other processes and recordings get a clean frame
+  grabFrame();
   ofSetColor(255);
   ofDrawBitmapString(ofToString(kBinnedParticles) + " particles", 32, 32);
   ofDrawBitmapString(ofToString((int) ofGetFrameRate()) + " fps", 32, 52);
   if (drawGui) gui.draw();
 }
 
+void ofApp::exit(){
+  // frames still being read back, then the ones waiting for an encoder
+  screenReader.flush([this](const unsigned char* pixels) { finishFrame(pixels); });
+  capture.close();
+  publisher.close();
+}
+
 void ofApp::keyPressed(int key){
+  // grabbed at the end of the next draw, encoded in the background
   if(key == 'p') {
-    ofSaveScreen(ofToString(ofGetMinutes()) + "_" + ofToString(ofGetFrameNum()) + ".png");
+    saveScreen = true;
+  }
+  // record a sequence, png with 'r' or raw rgb bytes with 'R'
+  if(key == 'r' || key == 'R') {
+    recording = !recording;
+    if(recording) {
+      recordExtension = key == 'r' ? "png" : "raw";
+      recordPath = "capture/" + ofGetTimestampString();
+      ofDirectory::createDirectory(recordPath, true, true);
+    } else {
+      ofLogNotice("depths") << "recorded to " << recordPath << ", "
+        << capture.getWritten() << " frames written and "
+        << capture.getDropped() << " dropped so far";
+    }
   }
   if(key == 's') {
     slowMotion = !slowMotion;
@@ -1,6 +1,10 @@
 #pragma once
 
 #include "BinnedParticleSystem.h"
+#include "FrameCapture.h"
+#include "ScreenReader.h"
+#include "SharedFramePublisher.h"
+#include "SplatRenderer.h"
 #include "ofMain.h"
 #include "ofxGui.h"
 #include "ofxOsc.h"
@@ -8,14 +12,22 @@
 
 class ofApp : public ofBaseApp {
   public:
+    ofApp();
     void setup();
     void update();
     void draw();
+    void exit();
 
     void keyPressed  (int key);
     void mousePressed(int x, int y, int button);
     void mouseReleased(int x, int y, int button);
     void handleOSCMessages();
+    void renderOffline();
+    bool updatePublisher();
+    int packParticles(SharedParticle* particles, int maxParticles);
+    void grabFrame();
+    void finishFrame(const unsigned char* pixels);
+    float particleAlpha(const BinnedParticle& particle);
     ofxPanel gui;
     ofParameter<float> timeStep;
     ofParameter<float> particleNeighborhood, particleRepulsion;
@@ -40,6 +52,9 @@ class ofApp : public ofBaseApp {
     ofParameter<bool> grEnabled;
     ofParameter<bool> fxaaEnabled;
 
+    ofParameter<bool> sharePixels;
+    ofParameter<bool> shareParticles;
+
     ofParameter<int> red;
     ofParameter<int> green;
     ofParameter<int> blue;
@@ -58,12 +73,38 @@ class ofApp : public ofBaseApp {
 
     bool drawBalls;
     bool drawGui;
+
+    // a frame waiting for its pixels to be read back
+    struct PendingFrame {
+      uint64_t frame;
+      double time;
+      vector<string> paths;
+      bool share;
+      vector<SharedParticle> particles; // as they were when the frame was drawn
+    };
+
+    ScreenReader screenReader;
+    deque<PendingFrame> pendingFrames;
+    FrameCapture capture;
+    SharedFramePublisher publisher;
+    // --share on the command line, /depths or /depths-headless by default
+    string shareName;
+    bool shareFailed;
+    bool saveScreen, recording;
+    string recordPath, recordExtension;
     ofxPostProcessing post;
     shared_ptr<ZoomBlurPass> zbpass;
     shared_ptr<GodRaysPass> grpass;
     shared_ptr<DofPass> dfpass;
     shared_ptr<FxaaPass> fxpass;
 
+    // headless mode renders on the CPU, see main.cpp
+    bool headless;
+    int headlessFrames, renderedFrames;
+    string renderPath;
+    SplatRenderer splatRenderer;
+    vector<ofVec2f> forceLines;
+
     ofxOscReceiver receive;
     ofxOscSender send;
 
@@ -0,0 +1,162 @@
+// reference consumer for the frames and particles depths publishes to
+// shared memory. it reads the newest frame in place and prints a summary.
+//
+//   g++ -std=c++11 -O2 -I../../src main.cpp -o shmconsumer -pthread -lrt
+//   ./shmconsumer [/depths]
+
+#include "SharedFrameLayout.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct Mapping {
+  void* memory;
+  size_t size;
+  SharedFrameHeader* header;
+};
+
+bool attach(const char* name, Mapping& mapping) {
+  int fd = shm_open(name, O_RDWR, 0);
+  if(fd < 0)
+    return false;
+  struct stat info;
+  if(fstat(fd, &info) < 0 || (size_t) info.st_size < sizeof(SharedFrameHeader)) {
+    close(fd);
+    return false;
+  }
+  // the mutex lives in the mapping, so it has to be writable
+  void* memory = mmap(NULL, info.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if(memory == MAP_FAILED)
+    return false;
+  SharedFrameHeader* header = (SharedFrameHeader*) memory;
+  if(header->magic != SHARED_FRAME_MAGIC) {
+    munmap(memory, info.st_size);
+    return false;
+  }
+  // pairs with the publisher's release fence before it writes the magic,
+  // the rest of the header is only safe to read after this
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if(header->version != SHARED_FRAME_VERSION ||
+      sharedFrameSize(header->slots, header->slotSize) > (size_t) info.st_size) {
+    munmap(memory, info.st_size);
+    return false;
+  }
+  mapping.memory = memory;
+  mapping.size = info.st_size;
+  mapping.header = header;
+  return true;
+}
+
+void detach(Mapping& mapping) {
+  if(mapping.memory != NULL)
+    munmap(mapping.memory, mapping.size);
+  mapping.memory = NULL;
+  mapping.header = NULL;
+}
+
+// waits up to 10ms for a frame newer than last, returns the newest. the
+// publisher skips the wake up when the mutex is busy, so waits stay short
+uint64_t waitForFrame(SharedFrameHeader* header, uint64_t last) {
+  sharedFrameLock(header);
+  while(header->sequence.load(std::memory_order_acquire) == last) {
+    timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_nsec += 10000000;
+    if(deadline.tv_nsec >= 1000000000) {
+      deadline.tv_sec++;
+      deadline.tv_nsec -= 1000000000;
+    }
+    if(sharedFrameWait(header, &deadline) == ETIMEDOUT)
+      break;
+  }
+  uint64_t latest = header->sequence.load(std::memory_order_acquire);
+  sharedFrameUnlock(header);
+  return latest;
+}
+
+int main(int argc, char* argv[]) {
+  const char* name = argc > 1 ? argv[1] : "/depths";
+  Mapping mapping = {NULL, 0, NULL};
+  uint64_t last = 0, skipped = 0, torn = 0;
+  // empty waits in a row, 200 of them is two seconds without a frame
+  int idle = 0;
+
+  while(true) {
+    if(mapping.header == NULL) {
+      if(!attach(name, mapping)) {
+        fprintf(stderr, "waiting for %s\n", name);
+        sleep(1);
+        continue;
+      }
+      last = mapping.header->sequence.load(std::memory_order_acquire);
+      idle = 0;
+      printf("attached to %s from process %d, %ux%u, %u particles max, %u slots\n", name,
+          (int) mapping.header->owner.load(),
+          mapping.header->width, mapping.header->height,
+          mapping.header->maxParticles, mapping.header->slots);
+    }
+
+    SharedFrameHeader* header = mapping.header;
+    uint64_t latest = waitForFrame(header, last);
+    if(latest == last) {
+      // the publisher may have restarted with a new segment
+      if(++idle >= 200)
+        detach(mapping);
+      continue;
+    }
+    idle = 0;
+    // only the newest frame is read, anything in between is skipped
+    skipped += latest - last - 1;
+    last = latest;
+
+    SharedFrameSlot* slot = sharedFrameGetSlot(header, latest);
+    uint64_t lock = slot->lock.load(std::memory_order_acquire);
+    if(lock != latest * 2) {
+      torn++;
+      continue;
+    }
+
+    // everything read from the slot, including its own fields, has to sit
+    // between the two lock checks. work on the data in place, no copies
+    uint64_t frame = slot->frame;
+    double time = slot->time;
+    uint32_t flags = slot->flags;
+    double brightness = 0;
+    if(flags & SHARED_FRAME_PIXELS) {
+      const unsigned char* pixels = sharedFrameGetPixels(slot);
+      size_t n = (size_t) header->width * header->height * header->channels;
+      for(size_t i = 0; i < n; i += 64) {
+        brightness += pixels[i];
+      }
+      brightness /= (n / 64) * 255.;
+    }
+    double speed = 0;
+    unsigned particles = 0;
+    if(flags & SHARED_FRAME_PARTICLES) {
+      const SharedParticle* particle = sharedFrameGetParticles(header, slot);
+      particles = slot->particles < header->maxParticles ? slot->particles : header->maxParticles;
+      for(unsigned i = 0; i < particles; i++) {
+        speed += sqrt(particle[i].xv * particle[i].xv + particle[i].yv * particle[i].yv);
+      }
+      if(particles > 0)
+        speed /= particles;
+    }
+
+    // if the publisher lapped us while reading, the numbers are garbage
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if(slot->lock.load(std::memory_order_relaxed) != lock) {
+      torn++;
+      continue;
+    }
+    printf("frame %llu  t %.3f  brightness %.3f  particles %u  speed %.3f  skipped %llu  torn %llu\n",
+        (unsigned long long) frame, time, brightness, particles, speed,
+        (unsigned long long) skipped, (unsigned long long) torn);
+  }
+}